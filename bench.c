@@ -0,0 +1,95 @@
+/*
+ * Benchmark of the batched access loop
+ * Runs a random trace from memory through the simulation kernel for growing
+ * L2 set counts and prints the time per access. Build it once with the default
+ * PREFETCH_DISTANCE and once with -DPREFETCH_DISTANCE=0 to see the gain of
+ * prefetching (make bench does both).
+ * Interface: ./bench
+ */
+
+#define L2CACHE_NO_MAIN
+#include "second.c"
+#include <time.h>
+
+#define BENCH_RECORDS (1 << 22)
+#define BENCH_BLOCK_BITS 2
+#define BENCH_RUNS 3
+
+// L1 is 2-way with 4 sets, L2 is 2-way with the given number of set bits
+#define BENCH_L1_SET_BITS 2
+#define BENCH_L1_BLOCKS 2
+#define BENCH_L2_BLOCKS 2
+
+// An LRU hit in a full L1 set copies to L2 with the L1 way count, see reference.h
+_Static_assert(BENCH_L1_BLOCKS <= BENCH_L2_BLOCKS, "LRU needs an L2 with at least as many ways as L1");
+
+// xorshift64, deterministic so that both builds run the same trace
+size_t nextRandom(size_t *state){
+    size_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+// Fill the batches with random blocks spread over four times the L2 sets
+struct TraceBatch *createBenchTrace(int num_batches, int set_bits_l2){
+    struct TraceBatch *batches = malloc(sizeof(struct TraceBatch) * num_batches);
+    size_t state = 88172645463325252ULL;
+    size_t span = (size_t) 4 << set_bits_l2;
+    for (int b = 0; b < num_batches; ++b) {
+        batches[b].len = BATCH_SIZE;
+        batches[b].done = false;
+        batches[b].collapse = false;
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            size_t r = nextRandom(&state);
+            batches[b].action[i] = (r & 1) ? 'W' : 'R';
+            batches[b].address[i] = ((r >> 1) % span + 1) << BENCH_BLOCK_BITS;
+            batches[b].count[i] = 1;
+            batches[b].writes[i] = r & 1;
+        }
+    }
+    return batches;
+}
+
+// Seconds spent by the kernel on the whole trace, best of BENCH_RUNS
+double runBench(int set_bits_l2){
+    int num_batches = BENCH_RECORDS / BATCH_SIZE;
+    int sets_l1 = 1 << BENCH_L1_SET_BITS;
+    int sets_l2 = 1 << set_bits_l2;
+    struct TraceBatch *batches = createBenchTrace(num_batches, set_bits_l2);
+    SimulationKernel kernel = selectKernel(BENCH_L1_BLOCKS, 1, BENCH_L2_BLOCKS);
+
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        size_t** cache_l1 = createNewCache(sets_l1, BENCH_L1_BLOCKS);
+        size_t** cache_l2 = createNewCache(sets_l2, BENCH_L2_BLOCKS);
+
+        clock_t start = clock();
+        for (int b = 0; b < num_batches; ++b) {
+            kernel(&batches[b], cache_l1, BENCH_BLOCK_BITS, BENCH_L1_SET_BITS, BENCH_L1_BLOCKS, 1, cache_l2, BENCH_BLOCK_BITS, set_bits_l2, BENCH_L2_BLOCKS);
+        }
+        double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+        if (run == 0 || elapsed < best){
+            best = elapsed;
+        }
+
+        deleteCache(cache_l1, sets_l1, BENCH_L1_BLOCKS);
+        deleteCache(cache_l2, sets_l2, BENCH_L2_BLOCKS);
+    }
+    free(batches);
+    return best;
+}
+
+int main(){
+    int set_bits[] = {12, 16, 18, 20, 22};
+
+    printf("prefetch distance %d, %d accesses\n", PREFETCH_DISTANCE, BENCH_RECORDS);
+    printf("%-10s %10s\n", "l2 sets", "ns/access");
+    for (size_t i = 0; i < sizeof(set_bits) / sizeof(set_bits[0]); ++i) {
+        double seconds = runBench(set_bits[i]);
+        printf("%-10d %10.2f\n", 1 << set_bits[i], seconds * 1e9 / BENCH_RECORDS);
+    }
+    return EXIT_SUCCESS;
+}
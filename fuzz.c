@@ -0,0 +1,388 @@
+/*
+ * Differential fuzzing of the simulation engine against the reference model
+ * Runs random geometries and traces through the engine and through reference.h,
+ * then compares the counters and the content of both caches. A mismatch is
+ * shrunk to a minimal trace and printed. make fuzz builds it with the same
+ * sanitizer flags as the simulator.
+ * Interface: ./fuzz [iterations] [seed]
+ */
+
+#define L2CACHE_NO_MAIN
+#include "second.c"
+#include "reference.h"
+
+#define FUZZ_ITERATIONS 2000
+#define FUZZ_MAX_RECORDS 2000
+
+// Engines under test
+#define ENGINE_UPDATE_CACHE 0   // updateCache, specialized kernel when there is one and repeats collapsed
+#define ENGINE_GENERIC 1        // generic kernel for every geometry, one record per access
+#define ENGINE_TRANSLATION 2    // updateCache with identity translation
+#define ENGINE_TIMING 3         // updateCache with identity translation and timing on
+#define NUM_ENGINES 4
+
+char *ENGINE_NAMES[NUM_ENGINES] = {"updateCache", "generic kernel", "updateCache with translation", "updateCache with translation and timing"};
+
+// DATA STRUCTURE
+struct FuzzCase {
+    int offset_bits;
+    int set_bits;
+    int ways;
+    int set_bits_l2;
+    int ways_l2;
+    bool isLRU;
+    bool terminated;    // the trace ends with #eof
+    int len;
+    char *actions;
+    size_t *addresses;
+};
+
+// Counters and caches once the trace is over
+struct FuzzResult {
+    int mem_reads;
+    int mem_writes;
+    int hits_l1;
+    int misses_l1;
+    int hits_l2;
+    size_t *l1;
+    size_t *l2;
+
+    // Translation engines only, the reference model does not translate
+    int num_tlbs;
+    int tlb_hits[MAX_TLB_LEVELS];
+    int tlb_misses[MAX_TLB_LEVELS];
+    int page_walks;
+};
+
+// xorshift64
+size_t fuzzRandom(size_t *state){
+    size_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+size_t numSlots(int set_bits, int ways){
+    return ((size_t) 1 << set_bits) * ways;
+}
+
+void createFuzzResult(struct FuzzResult *result, struct FuzzCase *fuzz_case){
+    result->l1 = calloc(numSlots(fuzz_case->set_bits, fuzz_case->ways), sizeof(size_t));
+    result->l2 = calloc(numSlots(fuzz_case->set_bits_l2, fuzz_case->ways_l2), sizeof(size_t));
+}
+
+void deleteFuzzResult(struct FuzzResult *result){
+    free(result->l1);
+    free(result->l2);
+}
+
+void deleteFuzzCase(struct FuzzCase *fuzz_case){
+    free(fuzz_case->actions);
+    free(fuzz_case->addresses);
+}
+
+// Random geometry, the L2 may have fewer ways than L1
+void randomGeometry(struct FuzzCase *fuzz_case, size_t *state){
+    int ways[] = {1, 2, 3, 4, 5, 8, 16};
+    fuzz_case->offset_bits = fuzzRandom(state) % 4;
+    fuzz_case->set_bits = fuzzRandom(state) % 4;
+    fuzz_case->ways = ways[fuzzRandom(state) % 7];
+    fuzz_case->set_bits_l2 = fuzzRandom(state) % 5;
+    int ways_l2[] = {1, 2, fuzz_case->ways, fuzz_case->ways + 1, fuzz_case->ways * 2, 16, 32};
+    fuzz_case->ways_l2 = ways_l2[fuzzRandom(state) % 7];
+    fuzz_case->isLRU = fuzzRandom(state) % 2;
+    fuzz_case->terminated = fuzzRandom(state) % 4 != 0;
+}
+
+// Random trace over a small span so sets conflict, with address 0 and runs of the same address
+void randomTrace(struct FuzzCase *fuzz_case, size_t *state){
+    size_t span = (size_t) 1 << (2 + fuzzRandom(state) % 9);
+    fuzz_case->len = 1 + fuzzRandom(state) % FUZZ_MAX_RECORDS;
+    fuzz_case->actions = malloc(fuzz_case->len);
+    fuzz_case->addresses = malloc(sizeof(size_t) * fuzz_case->len);
+    for (int i = 0; i < fuzz_case->len; ++i) {
+        size_t r = fuzzRandom(state) % 100;
+        fuzz_case->actions[i] = (fuzzRandom(state) % 2) ? 'W' : 'R';
+        if ( r < 5 ){
+            fuzz_case->addresses[i] = 0;
+        } else if ( r < 35 && i > 0 ){
+            fuzz_case->addresses[i] = fuzz_case->addresses[i - 1];
+        } else{
+            fuzz_case->addresses[i] = fuzzRandom(state) % span;
+        }
+    }
+}
+
+// Trace file of the case, ready to be read from the start
+FILE *writeFuzzTrace(struct FuzzCase *fuzz_case){
+    FILE *fp = tmpfile();
+    if ( fp == NULL ){
+        perror("tmpfile");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < fuzz_case->len; ++i) {
+        fprintf(fp, "%c 0x%zx\n", fuzz_case->actions[i], fuzz_case->addresses[i]);
+    }
+    if ( fuzz_case->terminated ){
+        fprintf(fp, "#eof\n");
+    }
+    rewind(fp);
+    return fp;
+}
+
+void runEngine(struct FuzzCase *fuzz_case, int engine, struct FuzzResult *result){
+    int sets = 1 << fuzz_case->set_bits;
+    int sets_l2 = 1 << fuzz_case->set_bits_l2;
+    int cache_policy = fuzz_case->isLRU ? 2 : 1;
+    size_t** cache_l1 = createNewCache(sets, fuzz_case->ways);
+    size_t** cache_l2 = createNewCache(sets_l2, fuzz_case->ways_l2);
+    FILE *fp = writeFuzzTrace(fuzz_case);
+    result->num_tlbs = 0;
+    result->page_walks = 0;
+
+    MEM_READS = 0;
+    MEM_WRITES = 0;
+    CACHE_HITS_L1 = 0;
+    CACHE_MISS_L1 = 0;
+    CACHE_HITS_L2 = 0;
+
+    if ( engine == ENGINE_GENERIC ){
+        struct TraceBatch batch;
+        batch.done = false;
+        batch.collapse = false;
+        batch.last_address = 0;
+        while (readTraceBatch(fp, &batch) > 0){
+            simulateGeneric(&batch, cache_l1, fuzz_case->offset_bits, fuzz_case->set_bits, fuzz_case->ways, fuzz_case->isLRU,
+                            cache_l2, fuzz_case->offset_bits, fuzz_case->set_bits_l2, fuzz_case->ways_l2);
+        }
+    } else if ( engine == ENGINE_TRANSLATION || engine == ENGINE_TIMING ){
+        struct Options options;
+        initOptions(&options);
+        options.translate = true;
+        options.timing = (engine == ENGINE_TIMING);
+        // Small TLBs of two levels so misses fill both and the repeats land in the first one
+        options.num_tlbs = 2;
+        options.tlb_entries[0] = 2;
+        options.tlb_ways[0] = 1;
+        options.tlb_entries[1] = 8;
+        options.tlb_ways[1] = 2;
+        struct Translation *translation = createTranslation(&options, fuzz_case->set_bits_l2, fuzz_case->offset_bits);
+        struct Timing *timing = createTiming(&options, fuzz_case->offset_bits);
+        updateCache(fp, cache_l1, fuzz_case->offset_bits, fuzz_case->set_bits, fuzz_case->ways, cache_policy,
+                    cache_l2, fuzz_case->offset_bits, fuzz_case->set_bits_l2, fuzz_case->ways_l2, cache_policy, translation, timing);
+        result->num_tlbs = translation->num_tlbs;
+        for (int i = 0; i < translation->num_tlbs; ++i) {
+            result->tlb_hits[i] = translation->tlb[i].hits;
+            result->tlb_misses[i] = translation->tlb[i].misses;
+        }
+        result->page_walks = translation->page_walks;
+        deleteTranslation(translation);
+        deleteTiming(timing);
+    } else{
+        updateCache(fp, cache_l1, fuzz_case->offset_bits, fuzz_case->set_bits, fuzz_case->ways, cache_policy,
+                    cache_l2, fuzz_case->offset_bits, fuzz_case->set_bits_l2, fuzz_case->ways_l2, cache_policy, NULL, NULL);
+    }
+
+    result->mem_reads = MEM_READS;
+    result->mem_writes = MEM_WRITES;
+    result->hits_l1 = CACHE_HITS_L1;
+    result->misses_l1 = CACHE_MISS_L1;
+    result->hits_l2 = CACHE_HITS_L2;
+    for (int i = 0; i < sets; ++i) {
+        memcpy(result->l1 + (size_t) i * fuzz_case->ways, cache_l1[i], sizeof(size_t) * fuzz_case->ways);
+    }
+    for (int i = 0; i < sets_l2; ++i) {
+        memcpy(result->l2 + (size_t) i * fuzz_case->ways_l2, cache_l2[i], sizeof(size_t) * fuzz_case->ways_l2);
+    }
+
+    fclose(fp);
+    deleteCache(cache_l1, sets, fuzz_case->ways);
+    deleteCache(cache_l2, sets_l2, fuzz_case->ways_l2);
+}
+
+void runReference(struct FuzzCase *fuzz_case, struct FuzzResult *result){
+    struct ReferenceModel model;
+    model.offset_bits = fuzz_case->offset_bits;
+    model.set_bits = fuzz_case->set_bits;
+    model.ways = fuzz_case->ways;
+    model.offset_bits_l2 = fuzz_case->offset_bits;
+    model.set_bits_l2 = fuzz_case->set_bits_l2;
+    model.ways_l2 = fuzz_case->ways_l2;
+    model.isLRU = fuzz_case->isLRU;
+    initReferenceModel(&model);
+
+    for (int i = 0; i < fuzz_case->len; ++i) {
+        referenceAccess(&model, fuzz_case->actions[i], fuzz_case->addresses[i]);
+    }
+
+    result->mem_reads = model.mem_reads;
+    result->mem_writes = model.mem_writes;
+    result->hits_l1 = model.hits_l1;
+    result->misses_l1 = model.misses_l1;
+    result->hits_l2 = model.hits_l2;
+    memcpy(result->l1, model.l1, sizeof(size_t) * numSlots(model.set_bits, model.ways));
+    memcpy(result->l2, model.l2, sizeof(size_t) * numSlots(model.set_bits_l2, model.ways_l2));
+    deleteReferenceModel(&model);
+}
+
+bool sameResult(struct FuzzCase *fuzz_case, struct FuzzResult *a, struct FuzzResult *b){
+    return a->mem_reads == b->mem_reads && a->mem_writes == b->mem_writes && a->hits_l1 == b->hits_l1 &&
+           a->misses_l1 == b->misses_l1 && a->hits_l2 == b->hits_l2 &&
+           memcmp(a->l1, b->l1, sizeof(size_t) * numSlots(fuzz_case->set_bits, fuzz_case->ways)) == 0 &&
+           memcmp(a->l2, b->l2, sizeof(size_t) * numSlots(fuzz_case->set_bits_l2, fuzz_case->ways_l2)) == 0;
+}
+
+// The translation run collapses repeats and the timing run does not, both must count the same TLB work
+bool sameTranslation(struct FuzzResult *a, struct FuzzResult *b){
+    if ( a->num_tlbs != b->num_tlbs || a->page_walks != b->page_walks ){
+        return false;
+    }
+    for (int i = 0; i < a->num_tlbs; ++i) {
+        if ( a->tlb_hits[i] != b->tlb_hits[i] || a->tlb_misses[i] != b->tlb_misses[i] ){
+            return false;
+        }
+    }
+    return true;
+}
+
+// First engine that disagrees with the reference, or the timing engine when its TLB counters
+// differ from the translation engine, -1 if all of them agree
+int checkCase(struct FuzzCase *fuzz_case){
+    struct FuzzResult expected;
+    createFuzzResult(&expected, fuzz_case);
+    runReference(fuzz_case, &expected);
+
+    int failed = -1;
+    int ran = 0;
+    struct FuzzResult actual[NUM_ENGINES];
+    for (; ran < NUM_ENGINES && failed < 0; ++ran) {
+        createFuzzResult(&actual[ran], fuzz_case);
+        runEngine(fuzz_case, ran, &actual[ran]);
+        if ( !sameResult(fuzz_case, &expected, &actual[ran]) ){
+            failed = ran;
+        } else if ( ran == ENGINE_TIMING && !sameTranslation(&actual[ENGINE_TRANSLATION], &actual[ran]) ){
+            failed = ran;
+        }
+    }
+    for (int i = 0; i < ran; ++i) {
+        deleteFuzzResult(&actual[i]);
+    }
+    deleteFuzzResult(&expected);
+    return failed;
+}
+
+// Remove chunks of records while the case keeps failing, halving the chunk when none can go
+void shrinkCase(struct FuzzCase *fuzz_case){
+    int chunk = fuzz_case->len / 2;
+    while ( chunk >= 1 ){
+        bool removed = false;
+        int start = 0;
+        while ( start < fuzz_case->len && fuzz_case->len > 1 ){
+            int end = start + chunk < fuzz_case->len ? start + chunk : fuzz_case->len;
+            struct FuzzCase candidate = *fuzz_case;
+            candidate.len = fuzz_case->len - (end - start);
+            candidate.actions = malloc(candidate.len);
+            candidate.addresses = malloc(sizeof(size_t) * candidate.len);
+            memcpy(candidate.actions, fuzz_case->actions, start);
+            memcpy(candidate.actions + start, fuzz_case->actions + end, fuzz_case->len - end);
+            memcpy(candidate.addresses, fuzz_case->addresses, sizeof(size_t) * start);
+            memcpy(candidate.addresses + start, fuzz_case->addresses + end, sizeof(size_t) * (fuzz_case->len - end));
+
+            if ( candidate.len > 0 && checkCase(&candidate) >= 0 ){
+                deleteFuzzCase(fuzz_case);
+                *fuzz_case = candidate;
+                removed = true;
+            } else{
+                deleteFuzzCase(&candidate);
+                start += chunk;
+            }
+        }
+        if ( !removed ){
+            chunk /= 2;
+        }
+    }
+}
+
+void printFirstDifference(char *name, size_t *expected, size_t *actual, size_t slots, int ways){
+    for (size_t i = 0; i < slots; ++i) {
+        if ( expected[i] != actual[i] ){
+            printf("%s set %zu way %zu: reference 0x%zx engine 0x%zx\n", name, i / ways, i % ways, expected[i], actual[i]);
+            return;
+        }
+    }
+}
+
+void printCase(struct FuzzCase *fuzz_case, int engine){
+    struct FuzzResult expected;
+    struct FuzzResult actual;
+    createFuzzResult(&expected, fuzz_case);
+    createFuzzResult(&actual, fuzz_case);
+    runReference(fuzz_case, &expected);
+    runEngine(fuzz_case, engine, &actual);
+
+    printf("mismatch in %s\n", ENGINE_NAMES[engine]);
+    printf("block bits:%d l1 set bits:%d l1 ways:%d l2 set bits:%d l2 ways:%d policy:%s\n",
+           fuzz_case->offset_bits, fuzz_case->set_bits, fuzz_case->ways, fuzz_case->set_bits_l2, fuzz_case->ways_l2,
+           fuzz_case->isLRU ? "lru" : "fifo");
+    printf("%-10s %10s %10s\n", "", "reference", "engine");
+    printf("%-10s %10d %10d\n", "memread", expected.mem_reads, actual.mem_reads);
+    printf("%-10s %10d %10d\n", "memwrite", expected.mem_writes, actual.mem_writes);
+    printf("%-10s %10d %10d\n", "l1hit", expected.hits_l1, actual.hits_l1);
+    printf("%-10s %10d %10d\n", "l1miss", expected.misses_l1, actual.misses_l1);
+    printf("%-10s %10d %10d\n", "l2hit", expected.hits_l2, actual.hits_l2);
+    printFirstDifference("l1", expected.l1, actual.l1, numSlots(fuzz_case->set_bits, fuzz_case->ways), fuzz_case->ways);
+    printFirstDifference("l2", expected.l2, actual.l2, numSlots(fuzz_case->set_bits_l2, fuzz_case->ways_l2), fuzz_case->ways_l2);
+    if ( engine == ENGINE_TIMING ){
+        struct FuzzResult translated;
+        createFuzzResult(&translated, fuzz_case);
+        runEngine(fuzz_case, ENGINE_TRANSLATION, &translated);
+        printf("%-10s %10s %10s\n", "", "collapsed", "engine");
+        for (int i = 0; i < actual.num_tlbs; ++i) {
+            printf("tlb%dhit    %10d %10d\n", i + 1, translated.tlb_hits[i], actual.tlb_hits[i]);
+            printf("tlb%dmiss   %10d %10d\n", i + 1, translated.tlb_misses[i], actual.tlb_misses[i]);
+        }
+        printf("%-10s %10d %10d\n", "pagewalk", translated.page_walks, actual.page_walks);
+        deleteFuzzResult(&translated);
+    }
+    printf("trace:\n");
+    for (int i = 0; i < fuzz_case->len; ++i) {
+        printf("%c 0x%zx\n", fuzz_case->actions[i], fuzz_case->addresses[i]);
+    }
+    if ( fuzz_case->terminated ){
+        printf("#eof\n");
+    }
+    deleteFuzzResult(&expected);
+    deleteFuzzResult(&actual);
+}
+
+int main( int argc, char *argv[argc+1]) {
+    long iterations = FUZZ_ITERATIONS;
+    size_t seed = 1;
+    if ( argc > 1 ){
+        iterations = strtol(argv[1], NULL, 10);
+    }
+    if ( argc > 2 ){
+        seed = strtoul(argv[2], NULL, 10);
+    }
+    // xorshift can not start from 0
+    size_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    for (long i = 0; i < iterations; ++i) {
+        struct FuzzCase fuzz_case;
+        randomGeometry(&fuzz_case, &state);
+        randomTrace(&fuzz_case, &state);
+
+        if ( checkCase(&fuzz_case) >= 0 ){
+            shrinkCase(&fuzz_case);
+            printf("case %ld of seed %zu fails\n", i, seed);
+            printCase(&fuzz_case, checkCase(&fuzz_case));
+            deleteFuzzCase(&fuzz_case);
+            return EXIT_FAILURE;
+        }
+        deleteFuzzCase(&fuzz_case);
+    }
+    printf("fuzz: %ld cases match the reference (seed %zu)\n", iterations, seed);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+//
+// Reference model of the L1/L2 simulation, written for clarity instead of speed
+// fuzz.c runs it next to the optimized engine and compares both
+//
+
+#ifndef L2CACHE_REFERENCE_H
+#define L2CACHE_REFERENCE_H
+
+/* Behavior of the engine kept on purpose, the graded outputs depend on it
+ * - Each way stores the whole address and 0 is an empty way, so address 0 hits
+ *   in any set that still has an empty way.
+ * - An L1 miss always inserts FIFO style, the L1 policy only matters on hits.
+ * - An LRU hit in a full L1 set copies the oldest L1 block to L2 and looks at
+ *   the first min(L1 ways, L2 ways) ways of the L2 set only. The L2 policy is
+ *   never used.
+ * - An L2 hit clears the matching way of the L2 set numbered by the set bits
+ *   (cache_l2[sets_l2][i] = 0), not of the set that hit.
+ * - printSubmitOutputFormat(1) moves one hit from memread/l2cachemiss to
+ *   l2cachehit, so the counters here are the raw ones.
+ */
+
+// DATA STRUCTURE
+struct ReferenceModel {
+    int offset_bits;
+    int set_bits;
+    int ways;
+    int offset_bits_l2;
+    int set_bits_l2;
+    int ways_l2;
+    bool isLRU;
+    size_t *l1;     // set major, ways of a set from oldest to newest
+    size_t *l2;
+
+    int mem_reads;
+    int mem_writes;
+    int hits_l1;
+    int misses_l1;
+    int hits_l2;
+};
+
+// Functions
+void initReferenceModel(struct ReferenceModel *model);
+void deleteReferenceModel(struct ReferenceModel *model);
+void referenceAccess(struct ReferenceModel *model, char action, size_t address);
+
+// The geometry fields must be set before
+void initReferenceModel(struct ReferenceModel *model){
+    model->l1 = calloc(((size_t) 1 << model->set_bits) * model->ways, sizeof(size_t));
+    model->l2 = calloc(((size_t) 1 << model->set_bits_l2) * model->ways_l2, sizeof(size_t));
+    model->mem_reads = 0;
+    model->mem_writes = 0;
+    model->hits_l1 = 0;
+    model->misses_l1 = 0;
+    model->hits_l2 = 0;
+}
+
+void deleteReferenceModel(struct ReferenceModel *model){
+    free(model->l1);
+    free(model->l2);
+    model->l1 = NULL;
+    model->l2 = NULL;
+}
+
+size_t *referenceL1Set(struct ReferenceModel *model, size_t address){
+    size_t set = (address >> model->offset_bits) & (((size_t) 1 << model->set_bits) - 1);
+    return model->l1 + set * model->ways;
+}
+
+size_t *referenceL2Set(struct ReferenceModel *model, size_t address){
+    size_t set = (address >> model->offset_bits_l2) & (((size_t) 1 << model->set_bits_l2) - 1);
+    return model->l2 + set * model->ways_l2;
+}
+
+// Index of the first way holding value in the first ways of the set, -1 if none
+int referenceFind(size_t *set, int ways, size_t value){
+    for (int i = 0; i < ways; ++i) {
+        if ( set[i] == value ){
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Put the address in the first empty way, or drop the oldest way and append it
+// Return the dropped block, 0 when there was an empty way
+size_t referenceInsert(size_t *set, int ways, size_t address){
+    int empty = referenceFind(set, ways, 0);
+    if ( empty >= 0 ){
+        set[empty] = address;
+        return 0;
+    }
+    size_t oldest = set[0];
+    memmove(set, set + 1, sizeof(size_t) * (ways - 1));
+    set[ways - 1] = address;
+    return oldest;
+}
+
+// LRU update of an L1 hit
+void referenceTouch(struct ReferenceModel *model, size_t *set, size_t address){
+    // The valid ways end before the first empty way after way 0
+    int last = model->ways - 1;
+    for (int i = 1; i < model->ways; ++i) {
+        if ( set[i] == 0 ){
+            last = i - 1;
+            break;
+        }
+    }
+    bool full = (last == model->ways - 1);
+
+    // Take the address out of the ways before the last one, the rest moves down
+    int found = referenceFind(set, last, address);
+    if ( found >= 0 ){
+        memmove(set + found, set + found + 1, sizeof(size_t) * (last - found));
+    }
+    if ( full ){
+        int ways_l2 = model->ways < model->ways_l2 ? model->ways : model->ways_l2;
+        referenceInsert(referenceL2Set(model, set[0]), ways_l2, set[0]);
+    }
+    set[last] = address;
+}
+
+void referenceAccess(struct ReferenceModel *model, char action, size_t address){
+    if ( action != 'R' ){
+        model->mem_writes++;
+    }
+
+    size_t *set = referenceL1Set(model, address);
+    if ( referenceFind(set, model->ways, address) >= 0 ){
+        model->hits_l1++;
+        if ( model->isLRU ){
+            referenceTouch(model, set, address);
+        }
+        return;
+    }
+
+    size_t *set_l2 = referenceL2Set(model, address);
+    int found = referenceFind(set_l2, model->ways_l2, address);
+    if ( found >= 0 ){
+        model->hits_l2++;
+        model->l2[(size_t) model->set_bits_l2 * model->ways_l2 + found] = 0;
+    }
+    model->misses_l1++;
+    model->mem_reads++;
+
+    // A full L1 set never holds 0, so 0 means there was an empty way
+    size_t evicted = referenceInsert(set, model->ways, address);
+    if ( evicted != 0 ){
+        referenceInsert(referenceL2Set(model, evicted), model->ways_l2, evicted);
+    }
+}
+
+#endif //L2CACHE_REFERENCE_H
@@ -1,8 +1,13 @@
 /*
  * Cache Cache simulator with L1 and L2 exclusive Cache
  * Author: Bryan Erazo
- * Interface: ./second <L1 cache size><L1 associativity><L1 cache policy><L1 block size><L2 cache size><L2 associativity><L2 cache policy><trace file>
+ * Interface: ./second <L1 cache size><L1 associativity><L1 cache policy><L1 block size><L2 cache size><L2 associativity><L2 cache policy><trace file> [options]
  *      Example: ./first 64 assoc:2 lru 4 trace1.txt
+ *      Options: translate the trace addresses before the L1 lookup
+ *      page:<bytes> alloc:<identity|random|color> tlb:<entries>:<ways> (one per TLB level)
+ *      Example: ./second 32 assoc:2 lru 4 64 assoc:4 lru trace1.txt page:4096 alloc:color tlb:16:4 tlb:512:8
+ *      Options: count the cycles of the trace, see parseOption for the defaults
+ *      timing latency:<l1>:<l2>:<mem> mshr:<l1>:<l2> dram:<banks>:<busy cycles>:<bytes per cycle> window:<accesses>
  *      TraceFile:
  *      R 0x01
  *      W 0x02
@@ -16,16 +21,27 @@
 #include <ctype.h>
 #include <math.h>
 #include "second.h"
+#include "translation.h"
+#include "timing.h"
 
 #define ARR_MAX 100
 
+// Force inlining of the per-access helpers so the kernels can fold their geometry
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// Simulation kernel: runs a batch of the trace for one L1/L2 geometry and policy
+typedef void (*SimulationKernel)(struct TraceBatch *batch, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2);
+
 int calculateSets(size_t cache_size,size_t block_size,unsigned int assocAction, size_t assoc);
 size_t ** createNewCache(int sets, int blocks);
 void deleteCache(size_t ** cache, int sets, int blocks);
-int searchAddressInCache(size_t** cache, size_t address, int num_block_offsets, int num_sets, int blocks);
-size_t** FIFO(size_t** cache, size_t address, int blocks_offset, int sets, int blocks,size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2);
-size_t** LRU(size_t** cache, size_t address, int block_offset, int sets, int blocks, size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2);
-void updateCache(FILE * trace_file, size_t** cache, int blocks_offset, int sets, int blocks, int cache_policy,size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2, int cache_policy_l2);
+ALWAYS_INLINE int searchAddressInCache(size_t** cache, size_t address, int num_block_offsets, int num_sets, int blocks);
+ALWAYS_INLINE size_t **FIFOCACHE2(size_t** cache, size_t address, int blocks_offset, int sets, int blocks);
+ALWAYS_INLINE size_t** FIFO(size_t** cache, size_t address, int blocks_offset, int sets, int blocks,size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2);
+ALWAYS_INLINE size_t** LRU(size_t** cache, size_t address, int block_offset, int sets, int blocks, size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2);
+int readTraceBatch(FILE * trace_file, struct TraceBatch *batch);
+SimulationKernel selectKernel(int blocks, int isLRU, int blocks_l2);
+void updateCache(FILE * trace_file, size_t** cache, int blocks_offset, int sets, int blocks, int cache_policy,size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2, int cache_policy_l2, struct Translation *translation, struct Timing *timing);
 
 
 void printGlobalVars();
@@ -70,6 +86,8 @@ void printSubmitOutputFormat(int dev){
     }
 }
 
+// bench.c includes this file with L2CACHE_NO_MAIN to drive the kernels directly
+#ifndef L2CACHE_NO_MAIN
 int main( int argc, char *argv[argc+1]) {
 
     long cache_size_l1;
@@ -78,11 +96,21 @@ int main( int argc, char *argv[argc+1]) {
     long block_size_l2;
 
     //File name from arguments
-    if (argc != 9 ){
+    if (argc < 9 ){
         printf("DEV Error 1: Give 5 arg as int: cache_size_l1, str: associativity_l1, str: cache_policy_l1, int: block_size_l1, int: cache_size_l2, str: associativity_l2, str: cache_policy_l2, str: trace_file\n");
         printf("error");
         return EXIT_SUCCESS;
     }
+    // Optional arguments after the trace file
+    struct Options options;
+    initOptions(&options);
+    for (int i = 9; i < argc; ++i) {
+        if ( !parseOption(argv[i], &options) ){
+            printf("DEV Error 4: Invalid option %s\n", argv[i]);
+            printf("error");
+            return EXIT_SUCCESS;
+        }
+    }
     // Check for power of 2 for cache_size_l1 and block_size_l1
     cache_size_l1 = getCacheSize(argv[1]);
     block_size_l1 = getBlockSize(argv[4]);
@@ -93,6 +121,12 @@ int main( int argc, char *argv[argc+1]) {
         printf("error");
         return EXIT_SUCCESS;
     }
+    // A block must fit in one page, otherwise the bytes of a block map to different frames
+    if (options.translate && options.page_size < block_size_l1){
+        printf("DEV Error 4: page size must be >= block_size_l1\n");
+        printf("error");
+        return EXIT_SUCCESS;
+    }
     long associativity_l1;
     unsigned int associativityAction_l1 = checkAssociativityInput(argv[2]);
     long associativity_l2;
@@ -155,76 +189,287 @@ int main( int argc, char *argv[argc+1]) {
     // Create a new cache_l1
     size_t** cache_l1 = createNewCache(NUM_SETS_L1, NUM_BLOCKS_L1);
     size_t** cache_l2 = createNewCache(NUM_SETS_L2, NUM_BLOCKS_L2);
+    struct Translation *translation = createTranslation(&options, SET_BITS_L2, OFFSET_BITS_L2);
+    struct Timing *timing = createTiming(&options, OFFSET_BITS_L1);
 
     // Receive the address and simulate the cache_l1
-    updateCache(fp, cache_l1, OFFSET_BITS_L1, SET_BITS_L1, NUM_BLOCKS_L1, cache_policy_l1, cache_l2, OFFSET_BITS_L2, SET_BITS_L2, NUM_BLOCKS_L2, cache_policy_l2);
+    updateCache(fp, cache_l1, OFFSET_BITS_L1, SET_BITS_L1, NUM_BLOCKS_L1, cache_policy_l1, cache_l2, OFFSET_BITS_L2, SET_BITS_L2, NUM_BLOCKS_L2, cache_policy_l2, translation, timing);
 
     // Print the results
     printSubmitOutputFormat(1);
+    printTranslationOutputFormat(translation);
+    printTimingOutputFormat(timing);
 
     // Close the file and destroy memory allocations
     fclose(fp);
     deleteCache(cache_l1, NUM_SETS_L1, NUM_BLOCKS_L1);
     deleteCache(cache_l2, NUM_SETS_L2, NUM_BLOCKS_L2);
+    deleteTranslation(translation);
+    deleteTiming(timing);
 
     return EXIT_SUCCESS;
 }
-// read from trace file and read/write addresses
-void updateCache(FILE * trace_file, size_t** cache, int blocks_offset, int sets, int blocks, int cache_policy,size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2, int cache_policy_l2){
+#endif //L2CACHE_NO_MAIN
+// Repeat L1 hits of an address that the previous access left in L1
+ALWAYS_INLINE void repeatL1Hits(size_t address, int repeats, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
 
-    // Set the policy to FIFO or LRU
-    int isLRU;
-    if (cache_policy == 1){
-        isLRU=0;
-    } else if ( cache_policy == 2){
-        isLRU=1;
+    CACHE_HITS_L1 += repeats;
+    if(isLRU == 0){
+        return;
     }
 
-    char action;
-    size_t address;
-    // reads until end of file
-    while((fscanf(trace_file, "%c %zx\n", &action, &address) != EOF) && (action != '#')){
+    size_t *set = cache[(address >> blocks_offset) & ((1 << sets) - 1)];
+    // Same valid ways as LRU: they end before the first empty way after way 0
+    int last = blocks - 1;
+    for(int i = 1; i < blocks; i++){
+        if(set[i] == (size_t) NULL){
+            last = i - 1;
+            break;
+        }
+    }
+    int settled = (set[last] == address);
+    for(int i = 0; i < last && settled; i++){
+        if(set[i] == address){
+            settled = 0;
+        }
+    }
 
-        // Increment for each write
-        if(action != 'R') {
-            MEM_WRITES++;
+    // LRU copies to the first ways of the L2 set, no more than the L2 has
+    int ways_l2 = blocks < blocks_l2 ? blocks : blocks_l2;
+    if(settled){
+        // LRU leaves L1 as it is and only copies the oldest way to L2 when the set is full.
+        // After 2 * ways_l2 copies those ways of the L2 set all hold it, so stop there
+        if(last == blocks - 1){
+            int copies = repeats < 2 * ways_l2 ? repeats : 2 * ways_l2;
+            for(int i = 0; i < copies; i++){
+                cache_l2 = FIFOCACHE2(cache_l2, set[0], blocks_offset_l2, sets_l2, ways_l2);
+            }
         }
+        return;
+    }
+    // Only address 0 gets here: it also matches the empty ways and each LRU update moves it, replay every hit
+    for(int i = 0; i < repeats; i++){
+        cache = LRU(cache, address, blocks_offset, sets, blocks, cache_l2, blocks_offset_l2,sets_l2,ways_l2);
+    }
+}
 
-        int isHit = searchAddressInCache(cache, address, blocks_offset, sets, blocks);
-        if(isHit == 1){
-            CACHE_HITS_L1++;
+// Simulate a single access against L1 and the exclusive L2, return the level that served it
+ALWAYS_INLINE int accessCache(size_t address, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
 
-            // Use th LRU eviction policy
-            if(isLRU != 0){
-                // update which block has been most recently used
-                cache = LRU(cache, address, blocks_offset, sets, blocks, cache_l2, blocks_offset_l2,sets_l2,blocks);
-            }
-        }else {
-            // Update miss and MEM_READS
-            int isHit2 = searchAddressInCache(cache_l2, address, blocks_offset_l2, sets_l2, blocks_l2);
-            if (isHit2 == 1){
-                CACHE_HITS_L2++;
-                size_t setIndex = (address >> blocks_offset_l2) & ((1 << sets_l2) - 1);
-                // Find the set in the block 1 for true and 0 for false
-                for(int i = 0; i < blocks_l2; i++){
-
-                    //if ((address >> (num_sets + num_block_offsets)) == cache[setIndex][i]){
-                    if (address == cache_l2[setIndex][i]){
-                        cache_l2[sets_l2][i]=0;
-                        break;
-                    }
-                }
+    int isHit = searchAddressInCache(cache, address, blocks_offset, sets, blocks);
+    if(isHit == 1){
+        CACHE_HITS_L1++;
 
+        // Use th LRU eviction policy
+        if(isLRU != 0){
+            // update which block has been most recently used, the copy to L2 stays within its ways
+            cache = LRU(cache, address, blocks_offset, sets, blocks, cache_l2, blocks_offset_l2,sets_l2,blocks < blocks_l2 ? blocks : blocks_l2);
+        }
+        return SERVED_L1;
+    }else {
+        // Update miss and MEM_READS
+        int isHit2 = searchAddressInCache(cache_l2, address, blocks_offset_l2, sets_l2, blocks_l2);
+        if (isHit2 == 1){
+            CACHE_HITS_L2++;
+            size_t setIndex = (address >> blocks_offset_l2) & ((1 << sets_l2) - 1);
+            // Find the set in the block 1 for true and 0 for false
+            for(int i = 0; i < blocks_l2; i++){
+
+                //if ((address >> (num_sets + num_block_offsets)) == cache[setIndex][i]){
+                if (address == cache_l2[setIndex][i]){
+                    cache_l2[sets_l2][i]=0;
+                    break;
+                }
             }
-            CACHE_MISS_L1++;
-            MEM_READS++;
 
-            cache = FIFO(cache, address, blocks_offset, sets, blocks,cache_l2, blocks_offset_l2,sets_l2,blocks_l2);
+        }
+        CACHE_MISS_L1++;
+        MEM_READS++;
+
+        cache = FIFO(cache, address, blocks_offset, sets, blocks,cache_l2, blocks_offset_l2,sets_l2,blocks_l2);
+        return isHit2 == 1 ? SERVED_L2 : SERVED_MEM;
+    }
+}
+
+// Simulate the count accesses of a record, return the level that served the first one
+ALWAYS_INLINE int accessRecord(size_t address, int count, int writes, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
+
+    // Increment for each write
+    MEM_WRITES += writes;
+
+    int served = accessCache(address, cache, blocks_offset, sets, blocks, isLRU, cache_l2, blocks_offset_l2, sets_l2, blocks_l2);
+    // After the first access the address is in L1
+    if(count > 1){
+        repeatL1Hits(address, count - 1, cache, blocks_offset, sets, blocks, isLRU, cache_l2, blocks_offset_l2, sets_l2, blocks_l2);
+    }
+    return served;
+}
+
+// Read the next batch of records, stops for good at the end of file or '#'.
+// With collapse on, consecutive accesses to the same address make a single record
+int readTraceBatch(FILE * trace_file, struct TraceBatch *batch){
+
+    char action;
+    batch->len = 0;
+    while (!batch->done && batch->len < BATCH_SIZE){
+        // address keeps its last value when a record has no valid address
+        if ((fscanf(trace_file, "%c %zx\n", &action, &batch->last_address) == EOF) || (action == '#')){
+            batch->done = true;
+            break;
+        }
+        int write = (action != 'R');
+        int last = batch->len - 1;
+
+        if (batch->collapse && last >= 0 && batch->address[last] == batch->last_address){
+            batch->count[last]++;
+            batch->writes[last] += write;
+            continue;
+        }
+        batch->action[batch->len] = action;
+        batch->address[batch->len] = batch->last_address;
+        batch->count[batch->len] = 1;
+        batch->writes[batch->len] = write;
+        batch->len++;
+    }
+    return batch->len;
+}
+
+// Prefetch the L1 and L2 sets of the record at index, the set pointers were prefetched earlier
+ALWAYS_INLINE void prefetchSets(struct TraceBatch *batch, int index, size_t** cache, size_t** cache_l2){
+    if (PREFETCH_DISTANCE > 0 && index < batch->len){
+        __builtin_prefetch(cache[batch->set[index]], 1);
+        __builtin_prefetch(cache_l2[batch->set_l2[index]], 1);
+    }
+}
+
+// Prefetch the pointers to the L1 and L2 sets of the record at index
+ALWAYS_INLINE void prefetchSetPointers(struct TraceBatch *batch, int index, size_t** cache, size_t** cache_l2){
+    if (PREFETCH_DISTANCE > 0 && index < batch->len){
+        __builtin_prefetch(&cache[batch->set[index]]);
+        __builtin_prefetch(&cache_l2[batch->set_l2[index]]);
+    }
+}
+
+// Simulate every access of a batch, prefetching the sets of the records ahead
+ALWAYS_INLINE void simulateBatch(struct TraceBatch *batch, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
+
+    size_t mask = (1 << sets) - 1;
+    size_t mask_l2 = (1 << sets_l2) - 1;
+
+    // Compute every set index of the batch ahead of the accesses
+    for(int i = 0; i < batch->len; i++){
+        batch->set[i] = (batch->address[i] >> blocks_offset) & mask;
+        batch->set_l2[i] = (batch->address[i] >> blocks_offset_l2) & mask_l2;
+    }
+
+    // Fill the pipeline: set pointers two distances ahead, sets one distance ahead
+    for(int i = 0; i < 2 * PREFETCH_DISTANCE; i++){
+        prefetchSetPointers(batch, i, cache, cache_l2);
+    }
+    for(int i = 0; i < PREFETCH_DISTANCE; i++){
+        prefetchSets(batch, i, cache, cache_l2);
+    }
+
+    for(int i = 0; i < batch->len; i++){
+        prefetchSetPointers(batch, i + 2 * PREFETCH_DISTANCE, cache, cache_l2);
+        prefetchSets(batch, i + PREFETCH_DISTANCE, cache, cache_l2);
+        batch->served[i] = accessRecord(batch->address[i], batch->count[i], batch->writes[i], cache, blocks_offset, sets, blocks, isLRU, cache_l2, blocks_offset_l2, sets_l2, blocks_l2);
+    }
+}
+
+// Generic kernel: geometry and policy are only known at run time
+void simulateGeneric(struct TraceBatch *batch, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
+    simulateBatch(batch, cache, blocks_offset, sets, blocks, isLRU, cache_l2, blocks_offset_l2, sets_l2, blocks_l2);
+}
+
+/* Specialized kernels
+ * One kernel per L1 policy and L1/L2 associativity in {1, 2, 4, 8, 16}. The
+ * ways and the policy are constants, so the way loops unroll and the LRU test
+ * disappears from the hot loop. Any other geometry uses simulateGeneric.
+ */
+#define DEFINE_KERNEL(POLICY, IS_LRU, WAYS, WAYS_L2) \
+    static void simulate_##POLICY##_##WAYS##_##WAYS_L2(struct TraceBatch *batch, size_t** cache, int blocks_offset, int sets, int blocks, int isLRU, size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){ \
+        (void) blocks; (void) isLRU; (void) blocks_l2; \
+        simulateBatch(batch, cache, blocks_offset, sets, WAYS, IS_LRU, cache_l2, blocks_offset_l2, sets_l2, WAYS_L2); \
+    }
+#define DEFINE_KERNELS_L2(POLICY, IS_LRU, WAYS) \
+    DEFINE_KERNEL(POLICY, IS_LRU, WAYS, 1) \
+    DEFINE_KERNEL(POLICY, IS_LRU, WAYS, 2) \
+    DEFINE_KERNEL(POLICY, IS_LRU, WAYS, 4) \
+    DEFINE_KERNEL(POLICY, IS_LRU, WAYS, 8) \
+    DEFINE_KERNEL(POLICY, IS_LRU, WAYS, 16)
+#define DEFINE_KERNELS(POLICY, IS_LRU) \
+    DEFINE_KERNELS_L2(POLICY, IS_LRU, 1) \
+    DEFINE_KERNELS_L2(POLICY, IS_LRU, 2) \
+    DEFINE_KERNELS_L2(POLICY, IS_LRU, 4) \
+    DEFINE_KERNELS_L2(POLICY, IS_LRU, 8) \
+    DEFINE_KERNELS_L2(POLICY, IS_LRU, 16)
+
+DEFINE_KERNELS(fifo, 0)
+DEFINE_KERNELS(lru, 1)
+
+#define KERNEL_ROW(POLICY, WAYS) \
+    { simulate_##POLICY##_##WAYS##_1, simulate_##POLICY##_##WAYS##_2, simulate_##POLICY##_##WAYS##_4, \
+      simulate_##POLICY##_##WAYS##_8, simulate_##POLICY##_##WAYS##_16 }
+#define KERNEL_TABLE(POLICY) \
+    { KERNEL_ROW(POLICY, 1), KERNEL_ROW(POLICY, 2), KERNEL_ROW(POLICY, 4), KERNEL_ROW(POLICY, 8), KERNEL_ROW(POLICY, 16) }
+
+// Indexed by [isLRU][log2(L1 ways)][log2(L2 ways)]
+static const SimulationKernel KERNELS[2][5][5] = { KERNEL_TABLE(fifo), KERNEL_TABLE(lru) };
+
+// Map the associativity to the kernel table, -1 if there is no specialized kernel
+int getKernelIndex(int blocks){
+    for (int i = 0; i < 5; ++i) {
+        if (blocks == (1 << i)){
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Pick the kernel for the geometry once, before the trace is read
+SimulationKernel selectKernel(int blocks, int isLRU, int blocks_l2){
+    int index = getKernelIndex(blocks);
+    int index_l2 = getKernelIndex(blocks_l2);
+    if (index < 0 || index_l2 < 0){
+        return simulateGeneric;
+    }
+    return KERNELS[isLRU != 0][index][index_l2];
+}
+
+// read from trace file and read/write addresses, translation is NULL for physical addresses and timing NULL to only count
+void updateCache(FILE * trace_file, size_t** cache, int blocks_offset, int sets, int blocks, int cache_policy,size_t** cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2, int cache_policy_l2, struct Translation *translation, struct Timing *timing){
+
+    // Set the policy to FIFO or LRU
+    int isLRU = 0;
+    if ( cache_policy == 2){
+        isLRU=1;
+    }
+
+    SimulationKernel kernel = selectKernel(blocks, isLRU, blocks_l2);
+
+    struct TraceBatch batch;
+    batch.done = false;
+    batch.last_address = 0;
+    // The timing model needs every access on its own
+    batch.collapse = (timing == NULL);
+    // reads until end of file, one batch at a time
+    while(readTraceBatch(trace_file, &batch) > 0){
+        if (translation != NULL){
+            for(int i = 0; i < batch.len; i++){
+                batch.address[i] = translateAddress(translation, batch.address[i], batch.count[i]);
+            }
+        }
+        kernel(&batch, cache, blocks_offset, sets, blocks, isLRU, cache_l2, blocks_offset_l2, sets_l2, blocks_l2);
+        if (timing != NULL){
+            for(int i = 0; i < batch.len; i++){
+                timeAccess(timing, batch.action[i], batch.address[i], batch.served[i]);
+            }
         }
     }
 }
 // Insert in the cache 2
-size_t **FIFOCACHE2(size_t** cache, size_t address, int blocks_offset, int sets, int blocks){
+ALWAYS_INLINE size_t **FIFOCACHE2(size_t** cache, size_t address, int blocks_offset, int sets, int blocks){
 
     size_t index = (address >> blocks_offset) & ((1 << sets) - 1);
 
@@ -257,7 +502,7 @@ size_t **FIFOCACHE2(size_t** cache, size_t address, int blocks_offset, int sets,
 }
 
 // insert the cache
-size_t** FIFO(size_t** cache, size_t address, int blocks_offset, int sets, int blocks,size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
+ALWAYS_INLINE size_t** FIFO(size_t** cache, size_t address, int blocks_offset, int sets, int blocks,size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
 
     size_t index = (address >> blocks_offset) & ((1 << sets) - 1);
 
@@ -310,7 +555,7 @@ size_t** LRUCACHEL2(size_t** cache, size_t address, int block_offset, int sets,
     return cache;
 }
 // Update the block by the most recent use
-size_t** LRU(size_t** cache, size_t address, int block_offset, int sets, int blocks, size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
+ALWAYS_INLINE size_t** LRU(size_t** cache, size_t address, int block_offset, int sets, int blocks, size_t **cache_l2, int blocks_offset_l2, int sets_l2, int blocks_l2){
     // use bit manipulation to obtain the the corresponding set and tag
     size_t index = (address >> block_offset) & ((1 << sets) - 1);
     //size_t tag = address >> (block_offset + sets);
@@ -337,7 +582,7 @@ size_t** LRU(size_t** cache, size_t address, int block_offset, int sets, int blo
     return cache;
 }
 
-int searchAddressInCache(size_t** cache, size_t address, int num_block_offsets, int num_sets, int blocks){
+ALWAYS_INLINE int searchAddressInCache(size_t** cache, size_t address, int num_block_offsets, int num_sets, int blocks){
 
     size_t setIndex = (address >> num_block_offsets) & ((1 << num_sets) - 1);
     // Find the set in the block 1 for true and 0 for false
@@ -588,6 +833,118 @@ long getNumberFromAssoc(char *arg){
     return num;
 }
 
+void initOptions(struct Options *options){
+    options->translate = false;
+    options->page_size = DEFAULT_PAGE_SIZE;
+    options->page_allocator = ALLOC_IDENTITY;
+    options->num_tlbs = 0;
+
+    options->timing = false;
+    options->latency_l1 = 4;
+    options->latency_l2 = 12;
+    options->latency_mem = 100;
+    options->mshrs_l1 = 8;
+    options->mshrs_l2 = 16;
+    options->banks = 8;
+    options->bank_busy = 40;
+    options->bytes_per_cycle = 8;
+    options->window = 64;
+}
+
+// Read count numbers > 0 separated by ':', false if the argument has more, less or invalid numbers
+bool getNumbersFromOption(char *arg, long *numbers, int count){
+    char *ptr = arg;
+    for (int i = 0; i < count; ++i) {
+        if ( i > 0 ){
+            if ( *ptr != ':' ){
+                return false;
+            }
+            ptr++;
+        }
+        numbers[i] = strtol(ptr, &ptr, 10);
+        if ( numbers[i] <= 0 ){
+            return false;
+        }
+    }
+    return *ptr == '\0';
+}
+
+bool parseOption(char *arg, struct Options *options){
+    /* Doc Function use, false if the option is invalid
+     * Translation:
+     * page:<bytes>                 page size, power of 2
+     * alloc:<allocator>            identity, random or color
+     * tlb:<entries>:<ways>         adds the next TLB level, powers of 2
+     * Timing:
+     * timing                       turns the timing on with the default values
+     * latency:<l1>:<l2>:<mem>      hit latency of each level and DRAM access latency
+     * mshr:<l1>:<l2>               miss status holding registers of each level, up to MAX_MSHRS
+     * dram:<banks>:<busy>:<bytes>  banks, cycles a bank is busy per access and bytes per cycle, up to MAX_BANKS banks
+     * window:<accesses>            accesses in flight before the core stalls, up to MAX_WINDOW
+     */
+    assert(arg != NULL);
+    long numbers[3];
+
+    if ( strncmp(arg, "page:", 5) == 0 ){
+        if ( !getNumbersFromOption(arg + 5, numbers, 1) || !IsPowerOfTwo(numbers[0]) || numbers[0] > (1L << 30) ){
+            return false;
+        }
+        options->page_size = numbers[0];
+        options->translate = true;
+    } else if ( strncmp(arg, "alloc:", 6) == 0 ){
+        options->page_allocator = getPageAllocator(arg + 6);
+        if ( options->page_allocator == 0 ){
+            return false;
+        }
+        options->translate = true;
+    } else if ( strncmp(arg, "tlb:", 4) == 0 ){
+        if ( options->num_tlbs == MAX_TLB_LEVELS || !getNumbersFromOption(arg + 4, numbers, 2) ){
+            return false;
+        }
+        if ( !IsPowerOfTwo(numbers[0]) || !IsPowerOfTwo(numbers[1]) || numbers[1] > numbers[0] ){
+            return false;
+        }
+        options->tlb_entries[options->num_tlbs] = numbers[0];
+        options->tlb_ways[options->num_tlbs] = numbers[1];
+        options->num_tlbs++;
+        options->translate = true;
+    } else if ( strcmp(arg, "timing") == 0 ){
+        options->timing = true;
+    } else if ( strncmp(arg, "latency:", 8) == 0 ){
+        if ( !getNumbersFromOption(arg + 8, numbers, 3) ){
+            return false;
+        }
+        options->latency_l1 = numbers[0];
+        options->latency_l2 = numbers[1];
+        options->latency_mem = numbers[2];
+        options->timing = true;
+    } else if ( strncmp(arg, "mshr:", 5) == 0 ){
+        if ( !getNumbersFromOption(arg + 5, numbers, 2) || numbers[0] > MAX_MSHRS || numbers[1] > MAX_MSHRS ){
+            return false;
+        }
+        options->mshrs_l1 = numbers[0];
+        options->mshrs_l2 = numbers[1];
+        options->timing = true;
+    } else if ( strncmp(arg, "dram:", 5) == 0 ){
+        if ( !getNumbersFromOption(arg + 5, numbers, 3) || numbers[0] > MAX_BANKS ){
+            return false;
+        }
+        options->banks = numbers[0];
+        options->bank_busy = numbers[1];
+        options->bytes_per_cycle = numbers[2];
+        options->timing = true;
+    } else if ( strncmp(arg, "window:", 7) == 0 ){
+        if ( !getNumbersFromOption(arg + 7, numbers, 1) || numbers[0] > MAX_WINDOW ){
+            return false;
+        }
+        options->window = numbers[0];
+        options->timing = true;
+    } else{
+        return false;
+    }
+    return true;
+}
+
 int getCachePolicy(char *arg){
     /* Function eviction policy
      * 0 is an error
@@ -5,6 +5,14 @@
 #ifndef L1CACHE_SECOND_H
 #define L1CACHE_SECOND_H
 
+// Records read from the trace per batch and how many records ahead the sets are prefetched
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 256
+#endif
+#ifndef PREFETCH_DISTANCE
+#define PREFETCH_DISTANCE 8
+#endif
+
 // DATA STRUCTURE
 struct Node {
     unsigned long address;
@@ -18,6 +26,50 @@ struct Cache {
     struct Node *linked_list;
 };
 
+// Records of the trace file read ahead of the simulation
+struct TraceBatch {
+    int len;
+    bool done;
+    bool collapse;              // merge consecutive accesses to the same address
+    size_t last_address;
+    char action[BATCH_SIZE];    // action of the first access of the record
+    size_t address[BATCH_SIZE];
+    int count[BATCH_SIZE];      // accesses in the record
+    int writes[BATCH_SIZE];     // writes among them
+    size_t set[BATCH_SIZE];
+    size_t set_l2[BATCH_SIZE];
+    char served[BATCH_SIZE];
+};
+
+// Optional arguments after the trace file
+#define MAX_TLB_LEVELS 4
+#define DEFAULT_PAGE_SIZE 4096
+// Upper bounds of the timing options, each one sizes an array
+#define MAX_MSHRS 4096
+#define MAX_BANKS 1024
+#define MAX_WINDOW 4096
+
+struct Options {
+    // Translation
+    bool translate;
+    long page_size;
+    int page_allocator;
+    int num_tlbs;
+    long tlb_entries[MAX_TLB_LEVELS];
+    long tlb_ways[MAX_TLB_LEVELS];
+    // Timing, latencies in cycles
+    bool timing;
+    long latency_l1;
+    long latency_l2;
+    long latency_mem;
+    long mshrs_l1;
+    long mshrs_l2;
+    long banks;
+    long bank_busy;
+    long bytes_per_cycle;
+    long window;
+};
+
 // Data-Structure Nodes Functions
 void insertNodeInTheBeginning(struct Node** head, unsigned long new_data);
 void deleteLinkedList(struct Node** head);
@@ -38,6 +90,8 @@ bool IsPowerOfTwo(unsigned long x);
 bool isEven(long int n);
 unsigned int checkAssociativityInput(char *arg);
 long getNumberFromAssoc(char *arg);
+void initOptions(struct Options *options);
+bool parseOption(char *arg, struct Options *options);
 
 // Data structure functions
 void insertNodeInTheBeginning(struct Node** head, unsigned long new_data){
@@ -0,0 +1,212 @@
+//
+// Approximate cycle accounting on top of the functional L1/L2 simulation
+//
+
+#ifndef L2CACHE_TIMING_H
+#define L2CACHE_TIMING_H
+
+// Where an access was served, as returned by the simulation
+#define SERVED_L1 1
+#define SERVED_L2 2
+#define SERVED_MEM 3
+
+/* Timing model
+ * The core issues one access per cycle in trace order and keeps up to window
+ * accesses in flight, they retire in order. A miss needs a free MSHR at its
+ * level, unless an MSHR already waits for the same line, then it merges with it
+ * and no new request is sent. When there is no free MSHR or the window is full
+ * the core stalls. L2 misses and every memory write go to a DRAM with banks that
+ * stay busy after each access and a single data bus of limited bandwidth.
+ * Writes are posted, the core never waits for them.
+ */
+
+// DATA STRUCTURE
+struct TimingLevel {
+    size_t latency;
+    int num_mshrs;
+    size_t *mshr_lines;
+    size_t *mshr_ready;     // cycle the line arrives, the MSHR is free from then on
+};
+
+struct Timing {
+    int block_bits;
+    size_t block_size;
+    struct TimingLevel l1;
+    struct TimingLevel l2;
+
+    // DRAM
+    size_t latency_mem;
+    size_t num_banks;
+    size_t bank_busy;
+    size_t transfer_cycles;
+    size_t *bank_ready;
+    size_t bus_ready;
+    size_t mem_bytes;
+
+    // Core
+    size_t window;
+    size_t *retire;         // retire cycle of the last window accesses
+    size_t accesses;
+    size_t now;             // earliest cycle to issue the next access
+    size_t last_retire;
+    size_t stall_cycles;
+};
+
+// Functions
+struct Timing *createTiming(struct Options *options, int offset_bits);
+void deleteTiming(struct Timing *timing);
+void timeAccess(struct Timing *timing, char action, size_t address, int served);
+void printTimingOutputFormat(struct Timing *timing);
+
+void createTimingLevel(struct TimingLevel *level, long latency, long num_mshrs){
+    level->latency = latency;
+    level->num_mshrs = num_mshrs;
+    level->mshr_lines = calloc(num_mshrs, sizeof(size_t));
+    level->mshr_ready = calloc(num_mshrs, sizeof(size_t));
+}
+
+// Return NULL when the options do not ask for timing
+struct Timing *createTiming(struct Options *options, int offset_bits){
+    if ( !options->timing ){
+        return NULL;
+    }
+    struct Timing *timing = malloc(sizeof(struct Timing));
+    timing->block_bits = offset_bits;
+    timing->block_size = (size_t) 1 << offset_bits;
+    createTimingLevel(&timing->l1, options->latency_l1, options->mshrs_l1);
+    createTimingLevel(&timing->l2, options->latency_l2, options->mshrs_l2);
+
+    timing->latency_mem = options->latency_mem;
+    timing->num_banks = options->banks;
+    timing->bank_busy = options->bank_busy;
+    timing->transfer_cycles = (timing->block_size + options->bytes_per_cycle - 1) / options->bytes_per_cycle;
+    timing->bank_ready = calloc(timing->num_banks, sizeof(size_t));
+    timing->bus_ready = 0;
+    timing->mem_bytes = 0;
+
+    timing->window = options->window;
+    timing->retire = calloc(timing->window, sizeof(size_t));
+    timing->accesses = 0;
+    timing->now = 0;
+    timing->last_retire = 0;
+    timing->stall_cycles = 0;
+    return timing;
+}
+
+void deleteTiming(struct Timing *timing){
+    if ( timing == NULL ){
+        return;
+    }
+    free(timing->l1.mshr_lines);
+    free(timing->l1.mshr_ready);
+    free(timing->l2.mshr_lines);
+    free(timing->l2.mshr_ready);
+    free(timing->bank_ready);
+    free(timing->retire);
+    free(timing);
+}
+
+size_t maxCycle(size_t a, size_t b){
+    return a > b ? a : b;
+}
+
+// MSHR still waiting for the line at cycle, -1 if there is none
+int findMshr(struct TimingLevel *level, size_t line, size_t cycle){
+    for (int i = 0; i < level->num_mshrs; ++i) {
+        if ( level->mshr_ready[i] > cycle && level->mshr_lines[i] == line ){
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Free MSHR at cycle, moves cycle to the first one that frees up when all of them are busy
+int allocateMshr(struct TimingLevel *level, size_t *cycle){
+    int earliest = 0;
+    for (int i = 0; i < level->num_mshrs; ++i) {
+        if ( level->mshr_ready[i] <= *cycle ){
+            return i;
+        }
+        if ( level->mshr_ready[i] < level->mshr_ready[earliest] ){
+            earliest = i;
+        }
+    }
+    *cycle = level->mshr_ready[earliest];
+    return earliest;
+}
+
+// Send a line to or from DRAM at cycle, return the cycle the transfer ends
+size_t accessDram(struct Timing *timing, size_t line, size_t cycle){
+    size_t bank = line % timing->num_banks;
+    size_t start = maxCycle(cycle, timing->bank_ready[bank]);
+    timing->bank_ready[bank] = start + timing->bank_busy;
+
+    size_t transfer = maxCycle(start + timing->latency_mem, timing->bus_ready);
+    timing->bus_ready = transfer + timing->transfer_cycles;
+    timing->mem_bytes += timing->block_size;
+    return timing->bus_ready;
+}
+
+// Account one access of the trace, served is the level the functional simulation found it at
+void timeAccess(struct Timing *timing, char action, size_t address, int served){
+
+    size_t line = address >> timing->block_bits;
+    size_t cycle = timing->now;
+
+    // Wait for the oldest access of the window to retire
+    if ( timing->accesses >= timing->window ){
+        cycle = maxCycle(cycle, timing->retire[timing->accesses % timing->window]);
+    }
+
+    size_t ready;
+    int pending = findMshr(&timing->l1, line, cycle);
+    if ( pending >= 0 ){
+        // The line is already on its way to L1
+        ready = maxCycle(cycle + timing->l1.latency, timing->l1.mshr_ready[pending]);
+    } else if ( served == SERVED_L1 ){
+        ready = cycle + timing->l1.latency;
+    } else{
+        int mshr = allocateMshr(&timing->l1, &cycle);
+        size_t request = cycle + timing->l1.latency + timing->l2.latency;
+        if ( served == SERVED_L2 ){
+            ready = request;
+        } else{
+            int pending_l2 = findMshr(&timing->l2, line, cycle);
+            if ( pending_l2 >= 0 ){
+                ready = maxCycle(request, timing->l2.mshr_ready[pending_l2]);
+            } else{
+                int mshr_l2 = allocateMshr(&timing->l2, &cycle);
+                request = cycle + timing->l1.latency + timing->l2.latency;
+                ready = accessDram(timing, line, request);
+                timing->l2.mshr_lines[mshr_l2] = line;
+                timing->l2.mshr_ready[mshr_l2] = ready;
+            }
+        }
+        timing->l1.mshr_lines[mshr] = line;
+        timing->l1.mshr_ready[mshr] = ready;
+    }
+
+    // Writes go through to memory
+    if ( action != 'R' ){
+        accessDram(timing, line, cycle);
+    }
+
+    timing->stall_cycles += cycle - timing->now;
+    timing->last_retire = maxCycle(timing->last_retire, ready);
+    timing->retire[timing->accesses % timing->window] = timing->last_retire;
+    timing->accesses++;
+    timing->now = cycle + 1;
+}
+
+void printTimingOutputFormat(struct Timing *timing){
+    if ( timing == NULL ){
+        return;
+    }
+    size_t cycles = maxCycle(timing->now, timing->last_retire);
+    printf("cycles:%zu\n", cycles);
+    printf("stallcycles:%zu\n", timing->stall_cycles);
+    printf("membytes:%zu\n", timing->mem_bytes);
+    printf("membandwidth:%.3f\n", cycles > 0 ? (double) timing->mem_bytes / cycles : 0.0);
+}
+
+#endif //L2CACHE_TIMING_H
@@ -0,0 +1,281 @@
+//
+// Virtual to physical translation ahead of the L1 lookup
+//
+
+#ifndef L2CACHE_TRANSLATION_H
+#define L2CACHE_TRANSLATION_H
+
+// Physical address bits, the random allocator scatters frames over this space
+#define PHYSICAL_ADDRESS_BITS 40
+
+// Page allocators: 1 identity, 2 random, 3 page-coloring
+#define ALLOC_IDENTITY 1
+#define ALLOC_RANDOM 2
+#define ALLOC_COLOR 3
+
+// DATA STRUCTURE
+// Set associative TLB, each set keeps its pages from least to most recently used
+struct Tlb {
+    size_t sets;
+    size_t ways;
+    size_t *pages;      // virtual page + 1, 0 is an empty way
+    size_t *frames;
+    int hits;
+    int misses;
+};
+
+// Open addressing map from virtual page to physical frame
+struct PageTable {
+    size_t capacity;
+    size_t len;
+    size_t *pages;      // virtual page + 1, 0 is an empty slot
+    size_t *frames;
+};
+
+struct Translation {
+    int page_bits;
+    int allocator;
+    int num_tlbs;
+    int page_walks;
+    size_t next_frame;
+    size_t colors;
+    size_t *next_frame_of_color;
+    struct PageTable page_table;
+    struct Tlb tlb[MAX_TLB_LEVELS];
+};
+
+// Functions
+int getPageAllocator(char *arg);
+struct Translation *createTranslation(struct Options *options, int set_bits_l2, int offset_bits_l2);
+void deleteTranslation(struct Translation *translation);
+size_t translateAddress(struct Translation *translation, size_t address, int count);
+void printTranslationOutputFormat(struct Translation *translation);
+
+int getPageAllocator(char *arg){
+    /* Function page allocator
+     * 0 is an error
+     * 1 is identity -> physical page is the virtual page
+     * 2 is random -> pages scattered over the physical memory
+     * 3 is color -> physical page keeps the L2 color of the virtual page
+     */
+    if (arg == NULL){
+        return 0;
+    }
+    if ( strcmp(arg, "identity") == 0 ){
+        return ALLOC_IDENTITY;
+    } else if ( strcmp(arg, "random") == 0 ){
+        return ALLOC_RANDOM;
+    } else if ( strcmp(arg, "color") == 0 ){
+        return ALLOC_COLOR;
+    } else {
+        return 0;
+    }
+}
+
+// Return NULL when the options do not ask for translation
+struct Translation *createTranslation(struct Options *options, int set_bits_l2, int offset_bits_l2){
+    if ( !options->translate ){
+        return NULL;
+    }
+    struct Translation *translation = malloc(sizeof(struct Translation));
+    translation->page_bits = log(options->page_size) / log(2);
+    translation->allocator = options->page_allocator;
+    translation->page_walks = 0;
+    translation->next_frame = 1;
+
+    // Number of pages that fit in one L2 way, each one a different color
+    int color_bits = set_bits_l2 + offset_bits_l2 - translation->page_bits;
+    translation->colors = (color_bits > 0) ? ((size_t) 1 << color_bits) : 1;
+    translation->next_frame_of_color = calloc(translation->colors, sizeof(size_t));
+
+    translation->page_table.capacity = 1024;
+    translation->page_table.len = 0;
+    translation->page_table.pages = calloc(translation->page_table.capacity, sizeof(size_t));
+    translation->page_table.frames = malloc(sizeof(size_t) * translation->page_table.capacity);
+
+    translation->num_tlbs = options->num_tlbs;
+    for (int i = 0; i < options->num_tlbs; ++i) {
+        struct Tlb *tlb = &translation->tlb[i];
+        tlb->ways = options->tlb_ways[i];
+        tlb->sets = options->tlb_entries[i] / options->tlb_ways[i];
+        tlb->pages = calloc(tlb->sets * tlb->ways, sizeof(size_t));
+        tlb->frames = malloc(sizeof(size_t) * tlb->sets * tlb->ways);
+        tlb->hits = 0;
+        tlb->misses = 0;
+    }
+    return translation;
+}
+
+void deleteTranslation(struct Translation *translation){
+    if ( translation == NULL ){
+        return;
+    }
+    for (int i = 0; i < translation->num_tlbs; ++i) {
+        free(translation->tlb[i].pages);
+        free(translation->tlb[i].frames);
+    }
+    free(translation->page_table.pages);
+    free(translation->page_table.frames);
+    free(translation->next_frame_of_color);
+    free(translation);
+}
+
+// Search the page in the TLB and make it the most recently used on a hit
+bool searchPageInTlb(struct Tlb *tlb, size_t page, size_t *frame){
+    size_t *pages = tlb->pages + (page & (tlb->sets - 1)) * tlb->ways;
+    size_t *frames = tlb->frames + (page & (tlb->sets - 1)) * tlb->ways;
+
+    for (size_t i = 0; i < tlb->ways && pages[i] != 0; ++i) {
+        if ( pages[i] == page + 1 ){
+            *frame = frames[i];
+            // Shift the more recent pages down and put this one last
+            size_t j = i;
+            while ( j + 1 < tlb->ways && pages[j + 1] != 0 ){
+                pages[j] = pages[j + 1];
+                frames[j] = frames[j + 1];
+                j++;
+            }
+            pages[j] = page + 1;
+            frames[j] = *frame;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Insert the page as the most recently used, evicts the least recently used when the set is full
+void insertPageInTlb(struct Tlb *tlb, size_t page, size_t frame){
+    size_t *pages = tlb->pages + (page & (tlb->sets - 1)) * tlb->ways;
+    size_t *frames = tlb->frames + (page & (tlb->sets - 1)) * tlb->ways;
+
+    size_t i = 0;
+    while ( i < tlb->ways && pages[i] != 0 ){
+        i++;
+    }
+    if ( i == tlb->ways ){
+        for (i = 1; i < tlb->ways; ++i) {
+            pages[i - 1] = pages[i];
+            frames[i - 1] = frames[i];
+        }
+        i = tlb->ways - 1;
+    }
+    pages[i] = page + 1;
+    frames[i] = frame;
+}
+
+// Scatter the frame counter over the physical frames, one to one so no frame is given twice
+size_t scatterFrame(size_t frame, int frame_bits){
+    size_t mask = ((size_t) 1 << frame_bits) - 1;
+    frame = (frame * 0x9E3779B97F4A7C15ULL) & mask;
+    frame ^= frame >> (frame_bits / 2);
+    frame = (frame * 0xBF58476D1CE4E5B9ULL) & mask;
+    return frame;
+}
+
+// Give a physical frame to a page touched for the first time. The random and color
+// allocators never give frame 0, so a translated address can not become the empty way of the cache
+size_t allocateFrame(struct Translation *translation, size_t page){
+    if ( translation->allocator == ALLOC_IDENTITY ){
+        return page;
+    } else if ( translation->allocator == ALLOC_RANDOM ){
+        int frame_bits = PHYSICAL_ADDRESS_BITS - translation->page_bits;
+        size_t frame = 0;
+        while ( frame == 0 ){
+            frame = scatterFrame(translation->next_frame++, frame_bits);
+        }
+        return frame;
+    } else{
+        // Next free frame of the same color as the virtual page
+        size_t color = page & (translation->colors - 1);
+        size_t index = ++translation->next_frame_of_color[color];
+        return index * translation->colors + color;
+    }
+}
+
+// Double the page table and insert back every page
+void growPageTable(struct PageTable *page_table){
+    struct PageTable old = *page_table;
+    page_table->capacity = old.capacity * 2;
+    page_table->pages = calloc(page_table->capacity, sizeof(size_t));
+    page_table->frames = malloc(sizeof(size_t) * page_table->capacity);
+    for (size_t i = 0; i < old.capacity; ++i) {
+        if ( old.pages[i] != 0 ){
+            size_t slot = ((old.pages[i] - 1) * 0x9E3779B97F4A7C15ULL) & (page_table->capacity - 1);
+            while ( page_table->pages[slot] != 0 ){
+                slot = (slot + 1) & (page_table->capacity - 1);
+            }
+            page_table->pages[slot] = old.pages[i];
+            page_table->frames[slot] = old.frames[i];
+        }
+    }
+    free(old.pages);
+    free(old.frames);
+}
+
+// Find the frame of the page, allocates one the first time the page is touched
+size_t walkPageTable(struct Translation *translation, size_t page){
+    struct PageTable *page_table = &translation->page_table;
+    translation->page_walks++;
+
+    size_t slot = (page * 0x9E3779B97F4A7C15ULL) & (page_table->capacity - 1);
+    while ( page_table->pages[slot] != 0 ){
+        if ( page_table->pages[slot] == page + 1 ){
+            return page_table->frames[slot];
+        }
+        slot = (slot + 1) & (page_table->capacity - 1);
+    }
+
+    size_t frame = allocateFrame(translation, page);
+    page_table->pages[slot] = page + 1;
+    page_table->frames[slot] = frame;
+    page_table->len++;
+    if ( page_table->len * 2 > page_table->capacity ){
+        growPageTable(page_table);
+    }
+    return frame;
+}
+
+// Translate a virtual address accessed count times in a row, looking through the TLB levels
+// before walking the page table
+size_t translateAddress(struct Translation *translation, size_t address, int count){
+    size_t page = address >> translation->page_bits;
+    size_t offset = address & (((size_t) 1 << translation->page_bits) - 1);
+    size_t frame = 0;
+
+    int level;
+    for (level = 0; level < translation->num_tlbs; ++level) {
+        if ( searchPageInTlb(&translation->tlb[level], page, &frame) ){
+            translation->tlb[level].hits++;
+            break;
+        }
+        translation->tlb[level].misses++;
+    }
+    if ( level == translation->num_tlbs ){
+        frame = walkPageTable(translation, page);
+    }
+    // Fill every level that missed
+    for (int i = 0; i < level; ++i) {
+        insertPageInTlb(&translation->tlb[i], page, frame);
+    }
+    // The page is now the most recent one of the first TLB, the repeats hit there
+    if ( translation->num_tlbs > 0 ){
+        translation->tlb[0].hits += count - 1;
+    } else{
+        translation->page_walks += count - 1;
+    }
+    return (frame << translation->page_bits) | offset;
+}
+
+void printTranslationOutputFormat(struct Translation *translation){
+    if ( translation == NULL ){
+        return;
+    }
+    for (int i = 0; i < translation->num_tlbs; ++i) {
+        printf("tlb%dhit:%d\n", i + 1, translation->tlb[i].hits);
+        printf("tlb%dmiss:%d\n", i + 1, translation->tlb[i].misses);
+    }
+    printf("pagewalk:%d\n", translation->page_walks);
+    printf("pages:%zu\n", translation->page_table.len);
+}
+
+#endif //L2CACHE_TRANSLATION_H